@@ -15,6 +15,7 @@ set -euo pipefail
 
 # Configuration
 readonly STUDENT_EXEC="grade_system"
+readonly STUDENT_LIBRARY="functions.so"
 readonly TESTCASE_FILE="TESTCASES.txt"
 readonly EXPECTED_OUTPUT="EXPECTED_OUTPUT.txt"
 readonly STUDENT_OUTPUT="STUDENT_OUTPUT.txt"
@@ -64,7 +65,7 @@ log_success() {
 }
 
 cleanup() {
-    rm -f "$STUDENT_OUTPUT" compile_errors.txt runtime_errors.txt
+    rm -f "$STUDENT_OUTPUT" compile_errors.txt runtime_errors.txt runner_output.txt
     rm -f expected_*.txt student_*.txt diff_*.txt
     if [ -f "$MAKEFILE" ]; then
         make clean >/dev/null 2>&1 || true
@@ -230,11 +231,60 @@ check_files() {
     echo "All required files found"
 }
 
+# Prints a content hash of everything that determines the built target:
+# target name, sources, header, Makefile (compiler flags) and the compiler version
+build_cache_key() {
+    local hash_cmd="sha256sum"
+    command -v sha256sum >/dev/null 2>&1 || hash_cmd="shasum -a 256"
+    
+    {
+        echo "$1"
+        cat functions.c driver.c grade_system.h "$MAKEFILE"
+        ${CC:-gcc} --version 2>/dev/null || true
+    } | $hash_cmd | cut -d' ' -f1
+}
+
+# True when GRADE_RUNNER names a prebuilt in-process runner (see make grade_runner)
+# and GRADE_DRIVER_OBJECT a prebuilt driver.o to link-check submissions against
+use_grade_runner() {
+    [ -n "${GRADE_RUNNER:-}" ] && [ -x "$GRADE_RUNNER" ] &&
+        [ -n "${GRADE_DRIVER_OBJECT:-}" ] && [ -f "$GRADE_DRIVER_OBJECT" ]
+}
+
 compile_code() {
     log_info "Compiling student code..."
     
+    # In-process runner: driver.c is already built into the runner and into
+    # GRADE_DRIVER_OBJECT, so only functions.c is compiled. It is linked against
+    # the driver object first (link-check), so link errors fail exactly as in a
+    # full build, and then packaged as the shared object the runner loads
+    local build_target="$STUDENT_EXEC"
+    local make_goals=("$STUDENT_EXEC")
+    if use_grade_runner; then
+        build_target="$STUDENT_LIBRARY"
+        make_goals=(DRIVER_OBJECT="$GRADE_DRIVER_OBJECT" link-check "$STUDENT_LIBRARY")
+    fi
+    
+    # Build cache (enabled by BUILD_CACHE_DIR): reuse the build output and
+    # compiler diagnostics of an identical earlier build
+    local cache_entry=""
+    if [ -n "${BUILD_CACHE_DIR:-}" ]; then
+        cache_entry="$BUILD_CACHE_DIR/$(build_cache_key "$build_target")"
+        if [ -x "$cache_entry/$build_target" ]; then
+            cp -p "$cache_entry/$build_target" "$build_target"
+            cp "$cache_entry/compile_errors.txt" compile_errors.txt
+            if [ -s compile_errors.txt ]; then
+                log_warning "Compilation warnings detected (cached build)"
+                COMPILATION_PENALTY=2
+            else
+                echo "Compilation successful (cached build)"
+            fi
+            return
+        fi
+    fi
+    
     # Reference compilation logic with penalty system
-    if make 2>compile_errors.txt; then
+    if make "${make_goals[@]}" 2>compile_errors.txt; then
         if [ -s compile_errors.txt ]; then
             log_warning "Compilation warnings detected"
             COMPILATION_PENALTY=2
@@ -247,15 +297,68 @@ compile_code() {
         exit 1
     fi
     
-    if [ ! -x "$STUDENT_EXEC" ]; then
+    if [ ! -x "$build_target" ]; then
         log_error "Executable not created"
         exit 1
     fi
+    
+    # Store the successful build; staged then renamed so concurrent runs never see half an entry
+    if [ -n "$cache_entry" ]; then
+        local staging="$cache_entry.tmp.$$"
+        if mkdir -p "$staging" && cp -p "$build_target" compile_errors.txt "$staging/"; then
+            mv -T "$staging" "$cache_entry" 2>/dev/null || rm -rf "$staging"
+        else
+            rm -rf "$staging"
+        fi
+    fi
+}
+
+# Runs the test file through the in-process runner. The runner applies the
+# timeout and reports crashes on its first line; the lines between that header
+# and the closing RUNNER_SUMMARY are the program output, scored as usual.
+run_in_process() {
+    "$GRADE_RUNNER" -j 1 -t "$TIMEOUT_SECONDS" ./"$STUDENT_LIBRARY" "$TESTCASE_FILE" \
+        > runner_output.txt 2>runtime_errors.txt || true
+    
+    local status
+    status=$(head -n 1 runner_output.txt | awk '{print $3}')
+    case "$status" in
+        DONE|TIMEOUT|CRASHED|FAILED)
+            sed '1d;$d' runner_output.txt > "$STUDENT_OUTPUT"
+            ;;
+        *)
+            cat runner_output.txt
+            : > "$STUDENT_OUTPUT"
+            ;;
+    esac
+    
+    case "$status" in
+        DONE)
+            echo "Program executed successfully"
+            if [ -s runtime_errors.txt ]; then
+                log_warning "Runtime warnings detected"
+                RUNTIME_PENALTY=1
+            fi
+            ;;
+        TIMEOUT)
+            log_error "Program timed out (possible infinite loop)"
+            RUNTIME_PENALTY=5
+            ;;
+        *)
+            log_error "Program crashed"
+            RUNTIME_PENALTY=10
+            ;;
+    esac
 }
 
 run_program() {
     log_info "Running student program..."
     
+    if use_grade_runner; then
+        run_in_process
+        return
+    fi
+    
     # Reference execution logic with sophisticated error handling
     if timeout "$TIMEOUT_SECONDS" ./"$STUDENT_EXEC" "$TESTCASE_FILE" > "$STUDENT_OUTPUT" 2>runtime_errors.txt; then
         echo "Program executed successfully"
@@ -35,6 +35,29 @@ chmod +x autograder_grade_system.sh
 # Create results directory with fixed name
 RESULTS_DIR="GRADING_RESULTS"
 
+# Build cache shared with the autograder: submissions whose functions.c (stubs
+# included), framework sources, Makefile and compiler are unchanged since an
+# earlier batch reuse that build instead of recompiling. Kept outside
+# RESULTS_DIR so it survives re-runs; delete the directory to force rebuilds.
+export BUILD_CACHE_DIR="${BUILD_CACHE_DIR:-$PWD/.build_cache}"
+mkdir -p "$BUILD_CACHE_DIR"
+
+# In-process runner: driver.c is identical for every submission, so it is built
+# once here, both as the runner and as the driver.o each submission is
+# link-checked against; each autograder run then only compiles functions.c.
+# Kept in the build cache because make clean runs between submissions; set
+# GRADE_RUNNER= (empty) beforehand to grade with full builds.
+if [ -z "${GRADE_RUNNER+set}" ]; then
+    if make RUNNER="$BUILD_CACHE_DIR/grade_runner" DRIVER_OBJECT="$BUILD_CACHE_DIR/driver.o" \
+            "$BUILD_CACHE_DIR/grade_runner" "$BUILD_CACHE_DIR/driver.o" >/dev/null 2>&1; then
+        export GRADE_RUNNER="$BUILD_CACHE_DIR/grade_runner"
+        export GRADE_DRIVER_OBJECT="$BUILD_CACHE_DIR/driver.o"
+    else
+        echo "⚠️  In-process runner unavailable - grading with full builds"
+        export GRADE_RUNNER=""
+    fi
+fi
+
 # Remove existing results directory if it exists for clean startup
 if [ -d "$RESULTS_DIR" ]; then
     echo "Removing existing results directory for clean startup..."
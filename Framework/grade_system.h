@@ -33,6 +33,7 @@
 #define OPERATION_CAPACITY_ERROR -2  /* Array at maximum capacity */
 #define OPERATION_DUPLICATE_ERROR -3 /* Duplicate student ID */
 #define OPERATION_NOT_FOUND -4        /* Student/data not found */
+#define OPERATION_IO_ERROR -5         /* Output file could not be written */
 
 /* ============================================================================
  * ASSESSMENT TYPE CONSTANTS
@@ -138,9 +139,31 @@ void initializeGradeArrays(void);
 
 /**
  * Processes test commands from input file
+ * Text test files and binary command streams (see encodeTestFile) are both accepted
  * Parameter: filename - name of test file to process
+ * Returns: OPERATION_SUCCESS, OPERATION_NOT_FOUND if the file cannot be opened
+ *          or OPERATION_IO_ERROR if a binary stream had a corrupt block
  */
-void processTestFile(const char* filename);
+int processTestFile(const char* filename);
+
+/**
+ * Converts a text test file into the compact binary command stream format
+ * (opcode bytes, varint/delta student IDs, fixed-point grades, checksummed blocks)
+ * Parameters: textFilename - test file to convert
+ *            binaryFilename - output file, overwritten if present
+ * Returns: OPERATION_SUCCESS, OPERATION_NOT_FOUND or OPERATION_IO_ERROR
+ */
+int encodeTestFile(const char* textFilename, const char* binaryFilename);
+
+/**
+ * Processes test commands from input file on three threads: a reader/parser,
+ * an in-order apply stage and a formatter, linked by lock-free SPSC rings.
+ * Output is identical to processTestFile as long as the student functions
+ * print nothing themselves; such output is not ordered with the driver's
+ * and may appear ahead of the results of earlier commands.
+ * Parameter: filename - name of test file to process
+ */
+void processTestFilePipelined(const char* filename);
 
 /**
  * Formats and displays student information for autograder output
@@ -154,6 +177,25 @@ void formatStudentOutput(int studentIndex);
  */
 void formatStatisticsOutput(void);
 
+/**
+ * Streams every student row to a file descriptor in one sequential pass
+ * Parameters: fd - destination descriptor
+ *            format - 1 = DISPLAY_STUDENT text, 2 = CSV, 3 = columnar binary
+ * Returns: OPERATION_SUCCESS, OPERATION_INVALID_INPUT or OPERATION_IO_ERROR
+ */
+int exportRoster(int fd, int format);
+
+/**
+ * Replays each test file into its own grade book on a pool of forked workers,
+ * prints the per-file outputs in input order and one merged CALCULATE_STATS line
+ * Parameters: filenames - test files to replay
+ *            fileCount - number of entries in filenames
+ *            workers - maximum number of concurrent workers
+ * Returns: OPERATION_SUCCESS if every file replayed, OPERATION_NOT_FOUND if a
+ *          worker failed, OPERATION_INVALID_INPUT/OPERATION_CAPACITY_ERROR on setup errors
+ */
+int replayTestFiles(const char* filenames[], int fileCount, int workers);
+
 /* ============================================================================
  * END OF HEADER FILE
  * ============================================================================ */
@@ -0,0 +1,27 @@
+/*
+ * ============================================================================
+ * RUNNER FAULT FIXTURE - Student functions that crash or hang on request
+ * Built by "make test-runner" as a shared object: the reference functions.c
+ * with displayStudentGrades() wrapped so that student ID 6666 segfaults and
+ * student ID 7777 never returns. Every other ID behaves normally.
+ * ============================================================================
+ */
+
+#include "grade_system.h"
+
+#include <signal.h>
+#include <unistd.h>
+
+#define displayStudentGrades referenceDisplayStudentGrades
+#include "functions.c"
+#undef displayStudentGrades
+
+int displayStudentGrades(int studentID) {
+    if(studentID == 6666) {
+        raise(SIGSEGV);
+    }
+    while(studentID == 7777) {
+        pause();
+    }
+    return referenceDisplayStudentGrades(studentID);
+}